@@ -0,0 +1,159 @@
+#pragma once
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <span>
+#include <array>
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+#include "stats.h"
+
+using byte = std::uint8_t;
+
+union volume_ptrs
+{
+    std::array<byte, 0x10> bytes;
+    struct [[gnu::packed]]
+    {
+        char volume[6];
+        std::uint32_t unknown;
+        std::uint16_t num_files;
+        std::uint32_t data_offset;
+    };
+};
+
+static_assert(sizeof(volume_ptrs) == 0x10);
+
+union file_entry
+{
+    std::array<byte, 0x20> bytes;
+    struct [[gnu::packed]]
+    {
+        char name[13];
+        byte compressed;
+        std::uint32_t offset;
+        std::uint32_t compressed_size;
+        std::uint32_t size;
+        byte unknown[5];
+        char magic;
+    };
+};
+
+static_assert(sizeof(file_entry) == 0x20);
+
+template <typename I, typename O>
+void decode(I in, std::size_t len, O out)
+{
+    byte key = 0xf2;
+    for(unsigned i = 0; i < len; ++i)
+    {
+        *out++ = *in++ xor key;
+        key += 0x11;
+    }
+}
+
+template <typename T>
+void decode(T data, std::size_t len)
+{
+    return decode(data, len, data);
+}
+
+template <typename I, typename O>
+void decompress(I src, O dst, const file_entry& f)
+{
+    const auto dst_begin = dst;
+    while (dst < dst_begin + f.size)
+    {
+        if (*src++ != f.magic)
+        {
+            *dst++ = *(src - 1);
+            continue;
+        }
+
+        byte lo = *src++;
+        byte hi = *src++;
+
+        if ((lo | hi) == 0)
+        {
+            *dst++ = f.magic;
+            continue;
+        }
+
+        std::size_t count = hi >> 2;
+        std::size_t offset = ((hi << 8) | lo) & 0x3ff;
+        auto clone_src = dst - offset - 1;
+        for(const auto dst_clone_begin = dst; dst < dst_clone_begin + count;)
+            *dst++ = *clone_src++;
+    }
+}
+
+// Reads the whole executable into memory once, so that entries can be
+// extracted independently (and concurrently) afterwards.
+struct archive
+{
+    explicit archive(const std::filesystem::path& infile)
+    {
+        if (not std::filesystem::is_regular_file(infile)) throw std::runtime_error { "Input file not found." };
+        std::ifstream in { infile, std::ios::binary | std::ios::ate };
+        in.exceptions(std::ios::badbit | std::ios::failbit);
+        data.resize(in.tellg());
+        in.seekg(0);
+        {
+            scoped_timer t { "read", data.size() };
+            in.read(data.data(), data.size());
+        }
+
+        if (data.size() < 0x10) throw std::runtime_error { "Bad HL.EXE" };
+        volume_ptrs vp;
+        decode(data.end() - 0x10, 0x10, vp.bytes.begin());
+        if (std::strncmp(vp.volume, "volume", 6) != 0) throw std::runtime_error { "Bad HL.EXE" };
+
+        std::size_t table_size = vp.num_files << 5;
+        if (data.size() < table_size + 0x10 or data.size() < vp.data_offset) throw std::runtime_error { "Bad HL.EXE" };
+        files.resize(vp.num_files);
+        auto table = data.end() - (table_size + 0x10);
+        std::vector<byte> table_data { table, table + table_size };
+        decode(table_data.begin(), table_size);
+        for (unsigned i = 0; i < vp.num_files; ++i)
+        {
+            std::copy_n(table_data.begin() + (i << 5), 0x20, files[i].bytes.begin());
+        }
+        data_offset = data.size() - vp.data_offset;
+    }
+
+    // Encoded, possibly compressed, contents of an entry.
+    std::span<const char> raw(const file_entry& f) const
+    {
+        if (data_offset + f.offset + f.compressed_size > data.size()) throw std::runtime_error { "Bad file entry." };
+        return { data.data() + data_offset + f.offset, f.compressed_size };
+    }
+
+    std::vector<char> extract(const file_entry& f) const
+    {
+        auto src = raw(f);
+        std::vector<char> compressed_data;
+        compressed_data.resize(f.compressed_size);
+        {
+            scoped_timer t { "decode", f.compressed_size };
+            decode(src.begin(), f.compressed_size, compressed_data.begin());
+        }
+        if (not f.compressed)
+        {
+            compressed_data.resize(f.size);
+            return compressed_data;
+        }
+
+        std::vector<char> out;
+        out.resize(f.size);
+        scoped_timer t { "decompress", f.size };
+        decompress(compressed_data.cbegin(), out.begin(), f);
+        return out;
+    }
+
+    std::vector<file_entry> files;
+    std::size_t data_offset;
+    std::vector<char> data;
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <stdexcept>
+
+// Layout of the game's data files and the soundtrack.  This has no library
+// dependencies, so that the generators can be built without png++ or FLAC++.
+
+using namespace std::literals;
+
+using byte = std::uint8_t;
+
+union image_chunk
+{
+    std::array<char, 0x2b0> bytes;
+    struct [[gnu::packed]]
+    {
+        byte image[0x240];
+        byte vga_lookup[0x10];
+        byte unknown0[0x10];
+        byte ega_lookup[0x10];
+        byte cga_lookup[0x10];
+        byte unknown1[0x08];
+        byte unknown2[0x04];
+        byte unknown3[0x24];
+    };
+};
+
+// Order in which the "!x.snd" fragments are played to form the soundtrack.
+constexpr auto soundtrack_sequence = "lllljjjkababdedemnmnghgissssttttaaabeeefopopghgh"
+                                     "mnmnghghscstscstcacbcdceqrqrhhhhjkjkghgisbsbsbst"
+                                     "aeaendndncncnnnfsbsjsbskstststsiadadbdbfrqrqhghg"
+                                     "opophghistscstscabdeabdfotothhhisssjssskstskstsc"sv;
+
+inline std::string soundtrack_fragment(char c)
+{
+    return "!"s + c + ".snd";
+}
+
+inline bool have_soundtrack(const std::unordered_map<std::string, std::vector<char>>& waves)
+{
+    for (auto& c : soundtrack_sequence)
+        if (waves.count(soundtrack_fragment(c)) == 0) return false;
+    return true;
+}
+
+inline std::vector<char> sequence_soundtrack(const std::unordered_map<std::string, std::vector<char>>& waves)
+{
+    std::vector<char> music { };
+    for (auto& c : soundtrack_sequence)
+    {
+        auto i = waves.find(soundtrack_fragment(c));
+        if (i == waves.end()) throw std::runtime_error { "Missing soundtrack files." };
+        music.insert(music.end(), i->second.cbegin(), i->second.cend());
+    }
+    return music;
+}
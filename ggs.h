@@ -0,0 +1,115 @@
+#pragma once
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <iomanip>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <span>
+#include <filesystem>
+#include <stdexcept>
+
+#define __STDC_LIB_EXT1__ 1
+#include <png++/png.hpp>
+
+#include "palette.h"
+#include "formats.h"
+#include "stats.h"
+
+inline std::string encode_png(const std::vector<byte>& image, png::uint_32 w, png::uint_32 h, png::uint_32 size_mult)
+{
+    scoped_timer t { "png.encode", image.size() };
+    static const hl_palette pal { };
+    png::image<png::index_pixel> png { w * size_mult, h * size_mult };
+    png.set_palette(pal.color);
+    png.set_tRNS(pal.alpha);
+
+    const auto m = size_mult;
+    for (unsigned y = 0; y < h; ++y)
+        for (unsigned x = 0; x < w; ++x)
+            for (unsigned ym = 0; ym < m; ++ym)
+                for (unsigned xm = 0; xm < m; ++xm)
+                    png[y * m + ym][x * m + xm] = image[x + y * w];
+
+    std::ostringstream out { };
+    png.write_stream(out);
+    return out.str();
+}
+
+inline void encode(std::filesystem::path p, const std::vector<byte>& image, png::uint_32 w, png::uint_32 h, png::uint_32 size_mult)
+{
+    auto data = encode_png(image, w, h, size_mult);
+    scoped_timer t { "write", data.size() };
+    std::ofstream out { p, std::ios::binary | std::ios::out | std::ios::trunc };
+    out.exceptions(std::ios::badbit | std::ios::failbit);
+    out.write(data.data(), data.size());
+}
+
+// Convert the contents of a .ggs file to .png.  The output is written to
+// 'out' with a .png extension, or to 'out-NN.png' for each sprite if
+// 'separate' is set.  Returns the paths of all files written.
+inline std::vector<std::filesystem::path> convert_ggs(std::span<const char> in, std::filesystem::path out, bool separate, png::uint_32 size_mult)
+{
+    std::vector<std::filesystem::path> written;
+    scoped_timer t { "ggs.convert" };
+    std::vector<std::vector<byte>> images;
+    images.resize(0x40);
+
+    std::size_t pos = 0x30;
+    for (unsigned count = 0; pos < in.size() and count < 0x40; ++count)
+    {
+        auto& image = images[count];
+        image.resize(24 * 24, 0xff);
+
+        if (static_cast<byte>(in[pos++]) == 0xff) continue;
+
+        if (pos + 0x2b0 > in.size()) throw std::runtime_error { "Truncated .ggs file." };
+        t.bytes += 1 + 0x2b0;
+        image_chunk chunk;
+        std::copy_n(in.begin() + pos, 0x2b0, chunk.bytes.begin());
+        pos += 0x2b0;
+
+        for (unsigned i = 0; i < 24 * 24; ++i)
+        {
+            byte a = chunk.image[i];
+            if (a != 0xff) a = chunk.vga_lookup[a];
+            image[i] = a;
+        }
+
+        if (separate)
+        {
+            auto p2 = out;
+            p2.replace_extension("");
+            std::stringstream s { };
+            s << "-" << std::setfill('0') << std::setw(2) << count << ".png";
+            p2 += s.str();
+            encode(p2, image, 24, 24, size_mult);
+            written.push_back(p2);
+        }
+    }
+    if (not separate)
+    {
+        for (auto& src : images) src.resize(24 * 24, 0xff);
+
+        std::vector<byte> image;
+        image.resize(8 * 8 * 24 * 24, 0xff);
+
+        for (unsigned y = 0; y < 8 * 24; ++y)
+        {
+            for (unsigned x = 0; x < 8 * 24; ++x)
+            {
+                auto n = x / 24 + y / 24 * 8;
+                auto x2 = x % 24, y2 = y % 24;
+                auto& src = images[n];
+                image[x + y * 24 * 8] = src[x2 + y2 * 24];
+            }
+        }
+
+        auto p2 = out;
+        p2.replace_extension(".png");
+        encode(p2, image, 8 * 24, 8 * 24, size_mult);
+        written.push_back(p2);
+    }
+    return written;
+}
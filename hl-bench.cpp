@@ -0,0 +1,119 @@
+// Measure the throughput of each processing stage on synthetic data.
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <filesystem>
+#include <string_view>
+
+#include "synthetic.h"
+#include "archive.h"
+#include "ggs.h"
+#include "snd.h"
+#include "options.h"
+#include "stats.h"
+
+namespace fs = std::filesystem;
+
+int main(int argc, char** argv)
+{
+    auto outdir = fs::temp_directory_path() / "hl-bench";
+    corpus_options corpus { };
+    unsigned iterations = 3;
+    unsigned size_mult = 4;
+    unsigned sample_mult = 6;
+    fs::path stats_json { }, trace { };
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view arg { argv[i] };
+        auto param = [&arg] (std::string_view prefix)
+        {
+            if (arg.starts_with(prefix))
+            {
+                arg.remove_prefix(prefix.size());
+                return true;
+            }
+            return false;
+        };
+
+        if (auto r = corpus.parse(arg); r != corpus_options::unknown) { if (r == corpus_options::invalid) return 1; }
+        else if (param("--outdir=")) outdir = arg;
+        else if (param("--iterations=")) { if (not parse_number(arg, iterations, 1, 1000)) return 1; }
+        else if (param("--size-mult=")) { if (not parse_number(arg, size_mult, 1, 100)) return 1; }
+        else if (param("--sample-mult=")) { if (not parse_number(arg, sample_mult, 1, 100)) return 1; }
+        else if (param("--stats-json=")) stats_json = arg;
+        else if (param("--trace="))
+        {
+            trace = arg;
+            stats.tracing = true;
+        }
+        else if (param("--help") or param("-?"))
+        {
+            auto self = fs::path(argv[0]).filename().string();
+            std::cout << "Usage: " << self << " [options]\n"
+                      << "Generate a synthetic archive and measure the throughput of decoding,\n"
+                      << "decompression, .ggs conversion and .snd conversion.\n\n"
+                      << "Available options:\n"
+                      << "      --outdir=DIR    Write temporary files to DIR. (default: \"" << outdir.string() << "\")\n"
+                      << corpus_options::help
+                      << "      --iterations=N  Process everything N times. (default: 3)\n"
+                      << "      --size-mult=N   Multiply image size by N. (default: 4)\n"
+                      << "      --sample-mult=N Multiply sample rate by N. (default: 6)\n"
+                      << "      --stats-json=FILE Write stage timings to FILE as JSON.\n"
+                      << "      --trace=FILE    Write a Chrome trace of all stages to FILE.\n"
+                      << "  -?, --help          Show this message.\n";
+            return 0;
+        }
+        else
+        {
+            std::cerr << "Unknown option: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    auto files = make_corpus(corpus);
+    std::size_t total = 0;
+    for (auto& f : files)
+    {
+        char magic;
+        scoped_timer t { "compress", f.data.size() };
+        compress(f.data, magic);
+        total += f.data.size();
+    }
+
+    fs::create_directories(outdir);
+    auto infile = outdir / "synthetic.exe";
+    {
+        auto data = make_archive(files);
+        std::ofstream out { infile, std::ios::binary | std::ios::out | std::ios::trunc };
+        out.exceptions(std::ios::badbit | std::ios::failbit);
+        out.write(data.data(), data.size());
+        std::cout << "Generated " << files.size() << " files, " << total << " bytes, archive size "
+                  << data.size() << " bytes.\n";
+    }
+
+    for (unsigned n = 0; n < iterations; ++n)
+    {
+        std::cout << "Iteration " << n + 1 << " of " << iterations << "...\n";
+        archive a { infile };
+        for (unsigned i = 0; i < a.files.size(); ++i)
+        {
+            auto& f = a.files[i];
+            auto data = a.extract(f);
+            if (data != files[i].data) throw std::runtime_error { "Round trip failed for " + files[i].name };
+
+            auto ext = fs::path { f.name }.extension();
+            auto p = outdir / f.name;
+            if (ext == ".ggs") convert_ggs(data, p, false, size_mult);
+            else if (ext == ".snd")
+            {
+                p.replace_extension(".flac");
+                encode(p.string(), data, sample_mult);
+            }
+        }
+    }
+
+    stats.report(true, stats_json, trace);
+    return 0;
+}
@@ -5,50 +5,28 @@
 #include <string>
 #include <unordered_map>
 #include <string_view>
-#include <charconv>
-#include <FLAC++/encoder.h>
+#include <map>
+#include <mutex>
+
+#include "snd.h"
+#include "manifest.h"
+#include "inputs.h"
+#include "options.h"
+#include "thread_pool.h"
+#include "stats.h"
 
 namespace fs = std::filesystem;
-using namespace std::literals;
 
 unsigned sample_mult = 6;
 
-void encode(std::string file, std::vector<char> in)
-{
-    std::vector<FLAC__int32> wave { };
-    wave.resize(in.size() * sample_mult);
-    for (unsigned i = 0; i < in.size(); ++i)
-    {
-        wave[i * sample_mult] = static_cast<signed>(static_cast<unsigned char>(in[i])) - 128;
-        for (unsigned j = 0; j < sample_mult; ++j) wave[i * sample_mult + j] = wave[i * sample_mult];
-    }
-
-    FLAC::Encoder::File out { };
-
-    bool ok = true;
-    ok &= out.set_verify(true);
-    ok &= out.set_compression_level(8);
-    ok &= out.set_channels(1);
-    ok &= out.set_bits_per_sample(8);
-    ok &= out.set_sample_rate(8523 * sample_mult);
-    ok &= out.set_total_samples_estimate(wave.size());
-
-    if(not ok or out.init(file) != FLAC__STREAM_ENCODER_INIT_STATUS_OK) throw std::runtime_error { "FLAC encoder broke." };
-
-    std::cout << "\x1b[30GEncoding " << file << "...";
-
-    auto* p = wave.data();
-    ok &= out.process(&p, wave.size());
-    ok &= out.finish();
-
-    if (not ok) throw std::runtime_error { "Encoding failed." };
-
-    std::cout << "\n";
-}
-
 int main(int argc, char** argv)
 {
     auto outdir = fs::path { "converted" };
+    bool force = false;
+    unsigned jobs = 0;
+    bool show_stats = false;
+    fs::path stats_json { }, trace { };
+    std::vector<fs::path> args { };
 
     for (int i = 1; i < argc; ++i)
     {
@@ -64,28 +42,36 @@ int main(int argc, char** argv)
         };
 
         if (param("--outdir=")) outdir = arg;
-        else if (param("--sample-mult="))
+        else if (param("--force")) force = true;
+        else if (param("--sample-mult=")) { if (not parse_number(arg, sample_mult, 1, 100, "multiplier")) return 1; }
+        else if (param("--jobs=") or param("-j")) { if (not parse_number(arg, jobs, 1, 1024, "number of jobs")) return 1; }
+        else if (param("--stats-json=")) stats_json = arg;
+        else if (param("--stats")) show_stats = true;
+        else if (param("--trace="))
         {
-            int m;
-            auto result = std::from_chars(arg.data(), arg.data() + arg.size(), m);
-            if (result.ec != std::errc { } or m < 1 or m > 100)
-            {
-                std::cerr << "Invalid multiplier: " << arg << "\n";
-                return 1;
-            }
-            sample_mult = m;
+            trace = arg;
+            stats.tracing = true;
         }
         else if (param("--help") or param("-?"))
         {
             auto self = fs::path(argv[0]).filename().string();
-            std::cout << "Usage: " << self << " [options]\n"
-                      << "Convert all .snd files in the current directory to .flac.\n\n"
+            std::cout << "Usage: " << self << " [options] [FILE|DIR...]\n"
+                      << "Convert .snd files to .flac, and sequence the soundtrack in each directory.\n"
+                      << "Directories are searched recursively, and a FILE of \"-\" reads a list of\n"
+                      << "files from stdin, one per line.  Without any arguments, all .snd files in\n"
+                      << "the current directory are converted.\n\n"
                       << "Available options:\n"
                       << "      --sample-mult=N Multiply sample rate by N. (default: 6)\n"
                       << "      --outdir=DIR    Write extracted files to DIR. (default: \"converted\")\n"
+                      << "      --force         Convert all files, even if they are unchanged.\n"
+                      << "  -jN, --jobs=N       Convert N files in parallel. (default: all cores)\n"
+                      << "      --stats         Show the time spent in each stage.\n"
+                      << "      --stats-json=FILE Write stage timings to FILE as JSON.\n"
+                      << "      --trace=FILE    Write a Chrome trace of all stages to FILE.\n"
                       << "  -?, --help          Show this message.\n";
             return 0;
         }
+        else if (arg == "-" or not arg.starts_with("-")) args.emplace_back(arg);
         else
         {
             std::cerr << "Unknown option: " << arg << "\n";
@@ -93,40 +79,89 @@ int main(int argc, char** argv)
         }
     }
 
-    std::unordered_map<std::string, std::vector<char>> waves { };
+    // Soundtrack fragments, grouped by directory.
+    std::map<fs::path, std::unordered_map<std::string, std::vector<char>>> soundtracks { };
     fs::create_directory(outdir);
-    for (auto& dir_entry : fs::directory_iterator("."))
+    manifest m { outdir / ".hl-convert-snd.manifest", "sample-mult=" + std::to_string(sample_mult), force };
+    std::mutex mutex;
+    unsigned skipped = 0;
+    thread_pool pool { jobs };
+    auto log = [&mutex] (std::string_view what, const fs::path& out)
     {
-        auto p = dir_entry.path().filename();
-        if (p.extension() != ".snd") continue;
+        std::unique_lock lock { mutex };
+        std::cout << what << "\x1b[30GEncoding " << out.string() << "...\n";
+    };
 
-        std::cout << "Reading " << p.string() << "...";
-
-        std::ifstream in { p, std::ios::binary | std::ios::ate };
-        in.exceptions(std::ios::badbit | std::ios::failbit);
-        auto size = in.tellg();
-        in.seekg(0);
-        auto& w = waves[p.string()];
-        w.resize(size);
-        in.read(w.data(), size);
+    for (auto& file : find_inputs(args, ".snd"))
+    {
+        pool.submit([&, file]
+        {
+            auto w = read_file(file.path);
+            auto key = file.name.generic_string();
+            std::uint64_t hash;
+            {
+                scoped_timer t { "hash", w.size() };
+                hash = content_hash(w);
+            }
+            if (not m.up_to_date(key, hash))
+            {
+                auto out = outdir / file.name;
+                out.replace_extension(".flac");
+                log("Reading " + file.path.string() + "...", out);
+                fs::create_directories(out.parent_path());
+                encode(out.string(), w, sample_mult);
+                m.update(key, hash, { out });
+            }
+            else
+            {
+                std::unique_lock lock { mutex };
+                ++skipped;
+            }
 
-        p.replace_extension(".flac");
-        encode((outdir / p).string(), w);
+            auto name = file.name.filename().string();
+            if (not name.starts_with('!')) return;
+            std::unique_lock lock { mutex };
+            soundtracks[file.name.parent_path()][name] = std::move(w);
+        });
     }
+    auto error = pool.wait_for_all();
 
-    std::vector<char> music { };
-    const auto seq = "lllljjjkababdedemnmnghgissssttttaaabeeefopopghgh"
-                     "mnmnghghscstscstcacbcdceqrqrhhhhjkjkghgisbsbsbst"
-                     "aeaendndncncnnnfsbsjsbskstststsiadadbdbfrqrqhghg"
-                     "opophghistscstscabdeabdfotothhhisssjssskstskstsc"sv;
-
-    std::cout << "Sequencing soundtrack... ";
-    for (auto& c : seq)
+    // Directories with only some of the fragments are skipped.
+    unsigned complete = 0;
+    for (auto& [dir, waves] : soundtracks)
     {
-        auto file = "!"s + c + ".snd";
-        if (waves.count(file) == 0) throw std::runtime_error { "Missing soundtrack files." };
-        auto& w = waves[file];
-        music.insert(music.end(), w.cbegin(), w.cend());
+        if (not have_soundtrack(waves))
+        {
+            std::cerr << "Warning: incomplete set of soundtrack files in " << (dir.empty() ? "." : dir.string()) << ", skipping.\n";
+            continue;
+        }
+        ++complete;
+        pool.submit([&]
+        {
+            auto music = sequence_soundtrack(waves);
+            auto key = (dir / "heartlight.flac").generic_string();
+            std::uint64_t hash;
+            {
+                scoped_timer t { "hash", music.size() };
+                hash = content_hash(music);
+            }
+            if (m.up_to_date(key, hash))
+            {
+                std::unique_lock lock { mutex };
+                ++skipped;
+                return;
+            }
+
+            auto out = outdir / dir / "heartlight.flac";
+            log("Sequencing soundtrack... ", out);
+            encode(out.string(), music, sample_mult);
+            m.update(key, hash, { out });
+        });
     }
-    encode((outdir / "heartlight.flac").string(), music);
+    if (auto e = pool.wait_for_all(); not error) error = e;
+    m.save();
+    if (error) std::rethrow_exception(error);
+    if (args.empty() and complete == 0) throw std::runtime_error { "Missing soundtrack files." };
+    if (skipped > 0) std::cout << "Skipped " << skipped << " unchanged files.\n";
+    stats.report(show_stats, stats_json, trace);
 }
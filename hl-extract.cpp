@@ -3,99 +3,87 @@
 
 #include <iostream>
 #include <fstream>
-#include <cstdint>
-#include <cstring>
+#include <sstream>
+#include <iomanip>
 #include <vector>
-#include <array>
-#include <algorithm>
 #include <filesystem>
 #include <string_view>
-
-using byte = std::uint8_t;
-
-union volume_ptrs
+#include <mutex>
+#include <list>
+
+#include "archive.h"
+#include "manifest.h"
+#include "inputs.h"
+#include "options.h"
+#include "thread_pool.h"
+#include "stats.h"
+
+// Extraction state for one archive.  If 'label' is not empty, it is
+// prepended to each file name in the output.
+struct extraction
 {
-    std::array<byte, 0x10> bytes;
-    struct [[gnu::packed]]
-    {
-        char volume[6];
-        std::uint32_t unknown;
-        std::uint16_t num_files;
-        std::uint32_t data_offset;
-    };
+    extraction(const std::filesystem::path& infile, std::filesystem::path dir, std::string label, bool force)
+        : a { infile }, outdir { std::move(dir) }, label { std::move(label) },
+          m { outdir / ".hl-extract.manifest", "", force } { }
+
+    archive a;
+    std::filesystem::path outdir;
+    std::string label;
+    manifest m;
+    unsigned skipped = 0;
 };
 
-static_assert(sizeof(volume_ptrs) == 0x10);
-
-union file_entry
+static void extract(extraction& x, const file_entry& f, std::mutex& mutex)
 {
-    std::array<byte, 0x20> bytes;
-    struct [[gnu::packed]]
-    {
-        char name[13];
-        byte compressed;
-        std::uint32_t offset;
-        std::uint32_t compressed_size;
-        std::uint32_t size;
-        byte unknown[5];
-        char magic;
-    };
-};
-
-static_assert(sizeof(file_entry) == 0x20);
+    namespace fs = std::filesystem;
 
-template <typename I, typename O>
-void decode(I in, std::size_t len, O out)
-{
-    byte key = 0xf2;
-    for(unsigned i = 0; i < len; ++i)
+    auto file = x.outdir / f.name;
+    std::uint64_t hash;
     {
-        *out++ = *in++ xor key;
-        key += 0x11;
+        auto raw = x.a.raw(f);
+        scoped_timer t { "hash", raw.size() };
+        hash = content_hash(raw, content_hash(f.bytes));
     }
-}
-
-template <typename T>
-void decode(T data, std::size_t len)
-{
-    return decode(data, len, data);
-}
-
-template <typename I, typename O>
-void decompress(I src, O dst, const file_entry& f)
-{
-    const auto dst_begin = dst;
-    while (dst < dst_begin + f.size)
+    if (x.m.up_to_date(f.name, hash))
     {
-        if (*src++ != f.magic)
-        {
-            *dst++ = *(src - 1);
-            continue;
-        }
+        std::unique_lock lock { mutex };
+        ++x.skipped;
+        return;
+    }
 
-        byte lo = *src++;
-        byte hi = *src++;
+    std::stringstream s { };
+    s << "Extracting " << x.label << f.name << ", ";
+    s << (x.label.empty() ? "\x1b[26G" : "") << "size: " << std::dec << std::setw(5) << f.size;
+    if (f.compressed) s << " (" << std::setw(5) << f.compressed_size << " compressed)";
+    else s << " (  not compressed)";
+    s << ", offset: 0x" << std::hex << (x.a.data_offset + f.offset) << ".\n";
+    {
+        std::unique_lock lock { mutex };
+        std::cout << s.str();
+    }
 
-        if ((lo | hi) == 0)
-        {
-            *dst++ = f.magic;
-            continue;
-        }
+    auto data = x.a.extract(f);
 
-        std::size_t count = hi >> 2;
-        std::size_t offset = ((hi << 8) | lo) & 0x3ff;
-        auto clone_src = dst - offset - 1;
-        for(const auto dst_clone_begin = dst; dst < dst_clone_begin + count;)
-            *dst++ = *clone_src++;
+    {
+        scoped_timer t { "write", data.size() };
+        fs::remove(file);
+        std::ofstream out { file , std::ios::binary | std::ios::out | std::ios::trunc };
+        out.exceptions(std::ios::badbit | std::ios::failbit);
+        out.write(data.data(), data.size());
     }
+    x.m.update(f.name, hash, { file });
 }
 
 int main(int argc, char** argv)
 {
     namespace fs = std::filesystem;
 
-    auto infile = fs::path { "HL.EXE" };
+    std::vector<fs::path> infiles { };
     auto outdir = fs::path{ "extracted" };
+    bool force = false;
+    unsigned jobs = 0;
+    bool show_stats = false;
+    fs::path stats_json { }, trace { };
 
     for (int i = 1; i < argc; ++i)
     {
@@ -110,19 +98,37 @@ int main(int argc, char** argv)
             return false;
         };
 
-        if (param("--infile=")) infile = arg;
+        if (param("--infile=")) infiles.emplace_back(arg);
         else if (param("--outdir=")) outdir = arg;
+        else if (param("--force")) force = true;
+        else if (param("--jobs=") or param("-j")) { if (not parse_number(arg, jobs, 1, 1024, "number of jobs")) return 1; }
+        else if (param("--stats-json=")) stats_json = arg;
+        else if (param("--stats")) show_stats = true;
+        else if (param("--trace="))
+        {
+            trace = arg;
+            stats.tracing = true;
+        }
         else if (param("--help") or param("-?"))
         {
             auto self = fs::path(argv[0]).filename().string();
-            std::cout << "Usage: " << self << " [options]\n"
-                      << "Extract graphics and sound assets from the Heartlight executable.\n\n"
+            std::cout << "Usage: " << self << " [options] [FILE...]\n"
+                      << "Extract graphics and sound assets from the Heartlight executable.\n"
+                      << "When several files are given, each is extracted to a subdirectory of the\n"
+                      << "output directory, named after its path.  A FILE of \"-\" reads a list of\n"
+                      << "files from stdin, one per line.\n\n"
                       << "Available options:\n"
                       << "      --infile=FILE   Extract data from FILE. (default: \"HL.EXE\")\n"
                       << "      --outdir=DIR    Write extracted files to DIR. (default: \"extracted\")\n"
+                      << "      --force         Extract all files, even if they are unchanged.\n"
+                      << "  -jN, --jobs=N       Extract N files in parallel. (default: all cores)\n"
+                      << "      --stats         Show the time spent in each stage.\n"
+                      << "      --stats-json=FILE Write stage timings to FILE as JSON.\n"
+                      << "      --trace=FILE    Write a Chrome trace of all stages to FILE.\n"
                       << "  -?, --help          Show this message.\n";
             return 0;
         }
+        else if (arg == "-" or not arg.starts_with("-")) infiles.emplace_back(arg);
         else
         {
             std::cerr << "Unknown option: " << arg << "\n";
@@ -130,65 +136,35 @@ int main(int argc, char** argv)
         }
     }
 
-    if (not fs::is_regular_file(infile)) throw std::runtime_error { "Input file not found." };
-    std::ifstream in { infile, std::ios::binary | std::ios::in };
-    in.exceptions(std::ios::badbit | std::ios::failbit);
+    if (infiles.empty()) infiles.emplace_back("HL.EXE");
+    infiles = read_inputs(infiles);
 
-    std::vector<file_entry> files;
-    std::size_t data_offset;
+    std::vector<fs::path> dirs { };
+    for (auto& infile : infiles) dirs.push_back(infiles.size() > 1 ? outdir / mirror_path(infile) : outdir);
+    check_unique(dirs);
 
+    std::mutex mutex;
+    std::list<extraction> extractions;
+    thread_pool pool { jobs };
+    for (unsigned i = 0; i < infiles.size(); ++i)
     {
-        volume_ptrs vp;
-        in.seekg(-0x10, std::ios::end);
-        in.read(reinterpret_cast<char*>(vp.bytes.data()), 0x10);
-        decode(vp.bytes.begin(), 0x10);
-        if (std::strncmp(vp.volume, "volume", 6) != 0) throw std::runtime_error { "Bad HL.EXE" };
-
-        std::size_t table_size = vp.num_files << 5;
-        std::vector<char> files_data;
-        files_data.resize(table_size);
-        files.resize(vp.num_files);
-        in.seekg(-(table_size + 0x10), std::ios::end);
-        in.read(files_data.data(), table_size);
-        decode(files_data.begin(), table_size);
-        for (unsigned i = 0; i < vp.num_files; ++i)
+        auto label = infiles.size() > 1 ? dirs[i].lexically_relative(outdir).string() + ": " : "";
+        fs::create_directories(dirs[i]);
+        auto& x = extractions.emplace_back(infiles[i], dirs[i], label, force);
         {
-            std::copy_n(files_data.begin() + (i << 5), 0x20, files[i].bytes.begin());
+            std::unique_lock lock { mutex };
+            std::cout << x.label << "Found " << x.a.files.size() << " file entries.\n";
         }
-        in.seekg(0, std::ios::end);
-        data_offset = static_cast<std::size_t>(in.tellg()) - vp.data_offset;
-        std::cout << "Found " << vp.num_files << " file entries.\n";
+        for (auto& f : x.a.files) pool.submit([&] { extract(x, f, mutex); });
     }
 
-    fs::create_directory(outdir);
-    for (auto& f : files)
+    auto error = pool.wait_for_all();
+    for (auto& x : extractions)
     {
-        std::cout << "Extracting " << f.name << ", ";
-        std::cout << "\x1b[26Gsize: " << std::dec << std::setw(5) << f.size;
-        if (f.compressed) std::cout << " (" << std::setw(5) << f.compressed_size << " compressed)";
-        else std::cout << " (  not compressed)";
-        std::cout << ", offset: 0x" << std::hex << (data_offset + f.offset) << ".\n";
-
-        in.seekg(data_offset + f.offset, std::ios::beg);
-
-        std::vector<char> compressed_data, data;
-        compressed_data.resize(f.compressed_size);
-        in.read(compressed_data.data(), f.compressed_size);
-        decode(compressed_data.begin(), f.compressed_size);
-        char* p = compressed_data.data();
-
-        if (f.compressed)
-        {
-            data.resize(f.size);
-            decompress(compressed_data.cbegin(), data.begin(), f);
-            p = data.data();
-        }
-
-        auto file = outdir / f.name;
-        fs::remove(file);
-        std::ofstream out { file , std::ios::binary | std::ios::out | std::ios::trunc };
-        out.exceptions(std::ios::badbit | std::ios::failbit);
-        out.write(p, f.size);
+        x.m.save();
+        if (x.skipped > 0) std::cout << x.label << "Skipped " << x.skipped << " unchanged files.\n";
     }
+    if (error) std::rethrow_exception(error);
+    stats.report(show_stats, stats_json, trace);
     return 0;
 }
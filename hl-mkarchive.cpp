@@ -0,0 +1,72 @@
+// Generate a synthetic Heartlight executable for testing and benchmarking.
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <filesystem>
+#include <string_view>
+
+#include "synthetic.h"
+
+namespace fs = std::filesystem;
+
+int main(int argc, char** argv)
+{
+    auto outfile = fs::path { "synthetic.exe" };
+    auto loose = fs::path { };
+    corpus_options corpus { };
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view arg { argv[i] };
+        auto param = [&arg] (std::string_view prefix)
+        {
+            if (arg.starts_with(prefix))
+            {
+                arg.remove_prefix(prefix.size());
+                return true;
+            }
+            return false;
+        };
+
+        if (auto r = corpus.parse(arg); r != corpus_options::unknown) { if (r == corpus_options::invalid) return 1; }
+        else if (param("--outfile=")) outfile = arg;
+        else if (param("--loose=")) loose = arg;
+        else if (param("--help") or param("-?"))
+        {
+            auto self = fs::path(argv[0]).filename().string();
+            std::cout << "Usage: " << self << " [options]\n"
+                      << "Generate a synthetic executable containing random .ggs and .snd files,\n"
+                      << "including a complete set of soundtrack fragments.\n\n"
+                      << "Available options:\n"
+                      << "      --outfile=FILE  Write the archive to FILE. (default: \"synthetic.exe\")\n"
+                      << "      --loose=DIR     Also write the uncompressed files to DIR.\n"
+                      << corpus_options::help
+                      << "  -?, --help          Show this message.\n";
+            return 0;
+        }
+        else
+        {
+            std::cerr << "Unknown option: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    auto files = make_corpus(corpus);
+    auto data = make_archive(files);
+
+    std::ofstream out { outfile, std::ios::binary | std::ios::out | std::ios::trunc };
+    out.exceptions(std::ios::badbit | std::ios::failbit);
+    out.write(data.data(), data.size());
+    std::cout << "Wrote " << files.size() << " files to " << outfile.string() << " (" << data.size() << " bytes).\n";
+
+    if (loose.empty()) return 0;
+    fs::create_directories(loose);
+    for (auto& f : files)
+    {
+        std::ofstream out { loose / f.name, std::ios::binary | std::ios::out | std::ios::trunc };
+        out.exceptions(std::ios::badbit | std::ios::failbit);
+        out.write(f.data.data(), f.data.size());
+    }
+    return 0;
+}
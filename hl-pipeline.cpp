@@ -0,0 +1,224 @@
+// Extract and convert all assets from the Heartlight executable in one pass.
+// Each entry is decompressed and passed straight to its converter, without
+// writing intermediate files.
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <filesystem>
+#include <string_view>
+#include <mutex>
+#include <list>
+
+#include "archive.h"
+#include "ggs.h"
+#include "snd.h"
+#include "thread_pool.h"
+#include "manifest.h"
+#include "inputs.h"
+#include "options.h"
+#include "stats.h"
+
+namespace fs = std::filesystem;
+
+// Conversion state for one archive.  Each entry's hash includes the options
+// that affect its output, so that changing e.g. the image size does not
+// re-encode any sounds.  The soundtrack depends on the hashes of all its
+// fragments.  If it needs to be rebuilt, it is encoded as soon as its last
+// fragment is available.  Archives without all fragments get no soundtrack.
+struct conversion
+{
+    conversion(const fs::path& infile, fs::path dir, const std::string& ggs_options, const std::string& snd_options, bool force)
+        : a { infile }, outdir { std::move(dir) }, m { outdir / ".hl-pipeline.manifest", "", force }
+    {
+        for (auto& f : a.files)
+        {
+            auto ext = fs::path { f.name }.extension();
+            auto& options = ext == ".ggs" ? ggs_options : snd_options;
+            auto raw = a.raw(f);
+            scoped_timer t { "hash", raw.size() };
+            hashes[f.name] = content_hash(options, content_hash(raw, content_hash(f.bytes)));
+        }
+
+        soundtrack_hash = content_hash(std::span<const char> { });
+        bool complete = true;
+        for (auto& c : soundtrack_sequence)
+        {
+            auto i = hashes.find(soundtrack_fragment(c));
+            if (i == hashes.end()) complete = false;
+            else soundtrack_hash = content_hash(std::span { reinterpret_cast<const std::uint8_t*>(&i->second), 8 }, soundtrack_hash);
+        }
+        if (not complete) std::cerr << "Warning: incomplete set of soundtrack files in " << infile.string() << ", skipping.\n";
+        else if (not m.up_to_date("heartlight.flac", soundtrack_hash))
+            for (auto& c : soundtrack_sequence) missing.insert(soundtrack_fragment(c));
+        needed = missing;
+    }
+
+    archive a;
+    fs::path outdir;
+    manifest m;
+    std::unordered_map<std::string, std::uint64_t> hashes { };
+    std::unordered_map<std::string, std::vector<char>> waves { };
+    std::unordered_set<std::string> missing { };
+    std::unordered_set<std::string> needed { };
+    std::uint64_t soundtrack_hash;
+};
+
+int main(int argc, char** argv)
+{
+    std::vector<fs::path> infiles { };
+    auto outdir = fs::path { "converted" };
+    bool separate = false;
+    png::uint_32 size_mult = 4;
+    unsigned sample_mult = 6;
+    unsigned jobs = 0;
+    bool show_stats = false;
+    fs::path stats_json { }, trace { };
+    bool force = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view arg { argv[i] };
+        auto param = [&arg] (std::string_view prefix)
+        {
+            if (arg.starts_with(prefix))
+            {
+                arg.remove_prefix(prefix.size());
+                return true;
+            }
+            return false;
+        };
+
+        if (param("--infile=")) infiles.emplace_back(arg);
+        else if (param("--outdir=")) outdir = arg;
+        else if (param("--separate")) separate = true;
+        else if (param("--force")) force = true;
+        else if (param("--size-mult=")) { if (not parse_number(arg, size_mult, 1, 100, "multiplier")) return 1; }
+        else if (param("--sample-mult=")) { if (not parse_number(arg, sample_mult, 1, 100, "multiplier")) return 1; }
+        else if (param("--jobs=") or param("-j")) { if (not parse_number(arg, jobs, 1, 1024, "number of jobs")) return 1; }
+        else if (param("--stats-json=")) stats_json = arg;
+        else if (param("--stats")) show_stats = true;
+        else if (param("--trace="))
+        {
+            trace = arg;
+            stats.tracing = true;
+        }
+        else if (param("--help") or param("-?"))
+        {
+            auto self = fs::path(argv[0]).filename().string();
+            std::cout << "Usage: " << self << " [options] [FILE...]\n"
+                      << "Extract graphics and sound assets from the Heartlight executable and\n"
+                      << "convert them to .png and .flac.  When several files are given, each is\n"
+                      << "converted to a subdirectory of the output directory, named after its path.\n"
+                      << "A FILE of \"-\" reads a list of files from stdin, one per line.\n\n"
+                      << "Available options:\n"
+                      << "      --infile=FILE   Extract data from FILE. (default: \"HL.EXE\")\n"
+                      << "      --outdir=DIR    Write converted files to DIR. (default: \"converted\")\n"
+                      << "      --separate      Write each 24x24 sprite to a separate file.\n"
+                      << "      --size-mult=N   Multiply image size by N. (default: 4)\n"
+                      << "      --sample-mult=N Multiply sample rate by N. (default: 6)\n"
+                      << "      --force         Convert all files, even if they are unchanged.\n"
+                      << "  -jN, --jobs=N       Run N conversions in parallel. (default: all cores)\n"
+                      << "      --stats         Show the time spent in each stage.\n"
+                      << "      --stats-json=FILE Write stage timings to FILE as JSON.\n"
+                      << "      --trace=FILE    Write a Chrome trace of all stages to FILE.\n"
+                      << "  -?, --help          Show this message.\n";
+            return 0;
+        }
+        else if (arg == "-" or not arg.starts_with("-")) infiles.emplace_back(arg);
+        else
+        {
+            std::cerr << "Unknown option: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    if (infiles.empty()) infiles.emplace_back("HL.EXE");
+    infiles = read_inputs(infiles);
+
+    auto ggs_options = "separate=" + std::to_string(separate) + " size-mult=" + std::to_string(size_mult);
+    auto snd_options = "sample-mult=" + std::to_string(sample_mult);
+
+    std::mutex mutex;
+    auto log = [&mutex] (std::string_view what, const fs::path& name)
+    {
+        std::unique_lock lock { mutex };
+        std::cout << what << ' ' << name.string() << "\n";
+    };
+
+    std::vector<fs::path> dirs { };
+    for (auto& infile : infiles) dirs.push_back(infiles.size() > 1 ? outdir / mirror_path(infile) : outdir);
+    check_unique(dirs);
+
+    std::list<conversion> conversions;
+    unsigned skipped = 0;
+    thread_pool pool { jobs };
+
+    for (unsigned i = 0; i < infiles.size(); ++i)
+    {
+        auto& infile = infiles[i];
+        auto& dir = dirs[i];
+        fs::create_directories(dir);
+        auto& c = conversions.emplace_back(infile, dir, ggs_options, snd_options, force);
+        if (infiles.size() > 1) log("Found " + std::to_string(c.a.files.size()) + " file entries in", infile);
+        else std::cout << "Found " << c.a.files.size() << " file entries.\n";
+
+        auto encode_soundtrack = [&]
+        {
+            auto music = sequence_soundtrack(c.waves);
+            auto file = c.outdir / "heartlight.flac";
+            log("Encoding", file);
+            encode(file.string(), music, sample_mult);
+            c.m.update("heartlight.flac", c.soundtrack_hash, { file });
+        };
+
+        for (auto& f : c.a.files)
+        {
+            auto ext = fs::path { f.name }.extension();
+            if (ext != ".ggs" and ext != ".snd") continue;
+
+            auto hash = c.hashes[f.name];
+            bool changed = not c.m.up_to_date(f.name, hash);
+            if (not changed and c.needed.count(f.name) == 0)
+            {
+                ++skipped;
+                continue;
+            }
+
+            pool.submit([&, ext, hash, changed, encode_soundtrack]
+            {
+                auto data = c.a.extract(f);
+                auto p = c.outdir / f.name;
+
+                if (ext == ".ggs")
+                {
+                    log("Converting", p);
+                    c.m.update(f.name, hash, convert_ggs(data, p, separate, size_mult));
+                    return;
+                }
+
+                if (changed)
+                {
+                    p.replace_extension(".flac");
+                    log("Encoding", p);
+                    encode(p.string(), data, sample_mult);
+                    c.m.update(f.name, hash, { p });
+                }
+
+                std::unique_lock lock { mutex };
+                if (c.missing.erase(f.name) == 0) return;
+                c.waves[f.name] = std::move(data);
+                if (c.missing.empty()) pool.submit(encode_soundtrack);
+            });
+        }
+    }
+
+    auto error = pool.wait_for_all();
+    for (auto& c : conversions) c.m.save();
+    if (error) std::rethrow_exception(error);
+    if (skipped > 0) std::cout << "Skipped " << skipped << " unchanged files.\n";
+    stats.report(show_stats, stats_json, trace);
+    return 0;
+}
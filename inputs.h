@@ -0,0 +1,109 @@
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+#include "stats.h"
+
+// Replace each "-" in 'args' by the list of paths read from stdin, one per
+// line.
+inline std::vector<std::filesystem::path> read_inputs(const std::vector<std::filesystem::path>& args)
+{
+    std::vector<std::filesystem::path> result;
+    for (auto& a : args)
+    {
+        if (a != "-")
+        {
+            result.push_back(a);
+            continue;
+        }
+
+        std::string line;
+        while (std::getline(std::cin, line))
+        {
+            if (not line.empty() and line.back() == '\r') line.pop_back();
+            if (not line.empty()) result.emplace_back(line);
+        }
+    }
+    return result;
+}
+
+// Path below an output directory that mirrors the input path 'p', so that
+// "a/x.snd" and "b/x.snd" do not collide.  The root and any ".." components
+// are dropped, so the result must still be checked with check_unique().
+inline std::filesystem::path mirror_path(const std::filesystem::path& p)
+{
+    std::filesystem::path result;
+    for (auto& part : p.lexically_normal().relative_path())
+        if (part != ".." and part != ".") result /= part;
+    return result;
+}
+
+// Throw if two inputs would be written to the same output.
+inline void check_unique(std::vector<std::filesystem::path> names)
+{
+    std::sort(names.begin(), names.end());
+    auto i = std::adjacent_find(names.begin(), names.end());
+    if (i != names.end()) throw std::runtime_error { "Several inputs would be written to " + i->string() };
+}
+
+struct input_file
+{
+    std::filesystem::path path;     // Where to read the file.
+    std::filesystem::path name;     // Path relative to the output directory.
+};
+
+// Find all files with the given extension.  Files named in 'args' keep their
+// path below the output directory, and directories are searched recursively,
+// keeping the structure below them.  If there are several arguments, each
+// directory also keeps its own path, so that several trees can be converted
+// at once.  Without any arguments, only the current directory is searched.
+// Throws if an argument is neither, or if two inputs end up with the same
+// name.
+inline std::vector<input_file> find_inputs(std::vector<std::filesystem::path> args, std::string_view ext)
+{
+    namespace fs = std::filesystem;
+    std::vector<input_file> result;
+
+    auto scan = [&] (auto it, const fs::path& root, const fs::path& prefix)
+    {
+        for (auto& dir_entry : it)
+        {
+            if (not dir_entry.is_regular_file()) continue;
+            auto& p = dir_entry.path();
+            if (p.extension() != ext) continue;
+            result.push_back({ p, prefix / p.lexically_relative(root) });
+        }
+    };
+
+    if (args.empty()) scan(fs::directory_iterator { "." }, ".", { });
+    auto inputs = read_inputs(args);
+    for (auto& a : inputs)
+    {
+        if (fs::is_directory(a)) scan(fs::recursive_directory_iterator { a }, a, inputs.size() > 1 ? mirror_path(a) : fs::path { });
+        else if (a.extension() == ext and fs::is_regular_file(a)) result.push_back({ a, mirror_path(a) });
+        else throw std::runtime_error { "Not a directory or " + std::string { ext } + " file: " + a.string() };
+    }
+
+    std::sort(result.begin(), result.end(), [] (auto& a, auto& b) { return a.name < b.name; });
+    auto i = std::adjacent_find(result.begin(), result.end(), [] (auto& a, auto& b) { return a.name == b.name; });
+    if (i != result.end()) throw std::runtime_error { "Both " + i->path.string() + " and " + (i + 1)->path.string() + " would be written to " + i->name.string() };
+    return result;
+}
+
+inline std::vector<char> read_file(const std::filesystem::path& p)
+{
+    std::ifstream in { p, std::ios::binary | std::ios::ate };
+    in.exceptions(std::ios::badbit | std::ios::failbit);
+    std::vector<char> data;
+    data.resize(in.tellg());
+    in.seekg(0);
+    scoped_timer t { "read", data.size() };
+    in.read(data.data(), data.size());
+    return data;
+}
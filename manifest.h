@@ -0,0 +1,113 @@
+#pragma once
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <span>
+#include <unordered_map>
+#include <filesystem>
+#include <mutex>
+#include <charconv>
+
+// 64-bit FNV-1a.  Pass a previous result as 'h' to hash several buffers in
+// sequence.
+inline std::uint64_t content_hash(std::span<const char> data, std::uint64_t h = 0xcbf29ce484222325)
+{
+    for (auto c : data)
+    {
+        h ^= static_cast<std::uint8_t>(c);
+        h *= 0x100000001b3;
+    }
+    return h;
+}
+
+inline std::uint64_t content_hash(std::span<const std::uint8_t> data, std::uint64_t h = 0xcbf29ce484222325)
+{
+    return content_hash(std::span<const char> { reinterpret_cast<const char*>(data.data()), data.size() }, h);
+}
+
+// Records, for each input, a hash of its contents and the outputs that were
+// produced from it.  An input is up to date if its hash is unchanged and all
+// of its outputs still exist.  The manifest is discarded entirely when the
+// options string differs from the one it was written with.
+struct manifest
+{
+    manifest(std::filesystem::path file, std::string options, bool force = false)
+        : file { std::move(file) }, options { std::move(options) }
+    {
+        if (force) return;
+        std::ifstream in { this->file };
+        if (not in) return;
+
+        std::string line;
+        if (not std::getline(in, line) or line != header()) return;
+
+        while (std::getline(in, line))
+        {
+            std::stringstream s { line };
+            std::string hash, key, out;
+            if (not std::getline(s, hash, '\t') or not std::getline(s, key, '\t')) continue;
+            std::uint64_t h;
+            auto result = std::from_chars(hash.data(), hash.data() + hash.size(), h, 16);
+            if (result.ec != std::errc { }) continue;
+            auto& e = entries[key];
+            e.hash = h;
+            while (std::getline(s, out, '\t')) e.outputs.emplace_back(out);
+        }
+    }
+
+    bool up_to_date(const std::string& key, std::uint64_t hash) const
+    {
+        std::unique_lock lock { mutex };
+        auto i = entries.find(key);
+        if (i == entries.end() or i->second.hash != hash) return false;
+        for (auto& out : i->second.outputs)
+            if (not std::filesystem::exists(file.parent_path() / out)) return false;
+        return true;
+    }
+
+    // Outputs are stored relative to the manifest's directory.
+    void update(const std::string& key, std::uint64_t hash, const std::vector<std::filesystem::path>& outputs)
+    {
+        std::unique_lock lock { mutex };
+        auto& e = entries[key];
+        e.hash = hash;
+        e.outputs.clear();
+        for (auto& out : outputs) e.outputs.push_back(out.lexically_relative(file.parent_path()));
+    }
+
+    void save() const
+    {
+        std::unique_lock lock { mutex };
+        auto tmp = file;
+        tmp += ".tmp";
+        {
+            std::ofstream out { tmp, std::ios::out | std::ios::trunc };
+            out.exceptions(std::ios::badbit | std::ios::failbit);
+            out << header() << '\n';
+            for (auto& [key, e] : entries)
+            {
+                out << std::hex << std::setfill('0') << std::setw(16) << e.hash << '\t' << key;
+                for (auto& p : e.outputs) out << '\t' << p.string();
+                out << '\n';
+            }
+        }
+        std::filesystem::rename(tmp, file);
+    }
+
+private:
+    std::string header() const { return "hl-manifest 1 " + options; }
+
+    struct entry
+    {
+        std::uint64_t hash;
+        std::vector<std::filesystem::path> outputs;
+    };
+
+    std::filesystem::path file;
+    std::string options;
+    std::unordered_map<std::string, entry> entries;
+    mutable std::mutex mutex;
+};
@@ -0,0 +1,20 @@
+#pragma once
+#include <iostream>
+#include <string_view>
+#include <charconv>
+
+// Parse 'arg' as a number between 'min' and 'max' into 'n'.  Prints an error
+// and returns false if it is not valid.  'what' names the value in the error
+// message.
+inline bool parse_number(std::string_view arg, unsigned& n, unsigned min, unsigned max, std::string_view what = "number")
+{
+    unsigned m;
+    auto result = std::from_chars(arg.data(), arg.data() + arg.size(), m);
+    if (result.ec != std::errc { } or m < min or m > max)
+    {
+        std::cerr << "Invalid " << what << ": " << arg << "\n";
+        return false;
+    }
+    n = m;
+    return true;
+}
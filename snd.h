@@ -0,0 +1,86 @@
+#pragma once
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include <FLAC++/encoder.h>
+
+#include "formats.h"
+#include "stats.h"
+
+// FLAC encoder that writes to memory, so that encoding and file output can
+// be timed separately.  Seeking is supported so that the encoder can fill in
+// the stream info when it is done.
+struct flac_buffer : FLAC::Encoder::Stream
+{
+    std::vector<char> data { };
+
+protected:
+    ::FLAC__StreamEncoderWriteStatus write_callback(const FLAC__byte buffer[], std::size_t bytes, std::uint32_t, std::uint32_t) override
+    {
+        if (pos + bytes > data.size()) data.resize(pos + bytes);
+        std::copy_n(buffer, bytes, data.begin() + pos);
+        pos += bytes;
+        return FLAC__STREAM_ENCODER_WRITE_STATUS_OK;
+    }
+
+    ::FLAC__StreamEncoderSeekStatus seek_callback(FLAC__uint64 offset) override
+    {
+        pos = offset;
+        return FLAC__STREAM_ENCODER_SEEK_STATUS_OK;
+    }
+
+    ::FLAC__StreamEncoderTellStatus tell_callback(FLAC__uint64* offset) override
+    {
+        *offset = pos;
+        return FLAC__STREAM_ENCODER_TELL_STATUS_OK;
+    }
+
+private:
+    std::size_t pos = 0;
+};
+
+inline std::vector<char> encode_flac(const std::vector<char>& in, unsigned sample_mult)
+{
+    scoped_timer t { "flac.encode", in.size() };
+    std::vector<FLAC__int32> wave { };
+    wave.resize(in.size() * sample_mult);
+    for (unsigned i = 0; i < in.size(); ++i)
+    {
+        wave[i * sample_mult] = static_cast<signed>(static_cast<unsigned char>(in[i])) - 128;
+        for (unsigned j = 0; j < sample_mult; ++j) wave[i * sample_mult + j] = wave[i * sample_mult];
+    }
+
+    flac_buffer out { };
+
+    bool ok = true;
+    ok &= out.set_verify(true);
+    ok &= out.set_compression_level(8);
+    ok &= out.set_channels(1);
+    ok &= out.set_bits_per_sample(8);
+    ok &= out.set_sample_rate(8523 * sample_mult);
+    ok &= out.set_total_samples_estimate(wave.size());
+
+    if(not ok or out.init() != FLAC__STREAM_ENCODER_INIT_STATUS_OK) throw std::runtime_error { "FLAC encoder broke." };
+
+    auto* p = wave.data();
+    {
+        scoped_timer t { "flac.process", in.size() };
+        ok &= out.process(&p, wave.size());
+        ok &= out.finish();
+    }
+
+    if (not ok) throw std::runtime_error { "Encoding failed." };
+    return std::move(out.data);
+}
+
+inline void encode(std::string file, const std::vector<char>& in, unsigned sample_mult)
+{
+    auto data = encode_flac(in, sample_mult);
+    scoped_timer t { "write", data.size() };
+    std::ofstream out { file, std::ios::binary | std::ios::out | std::ios::trunc };
+    out.exceptions(std::ios::badbit | std::ios::failbit);
+    out.write(data.data(), data.size());
+}
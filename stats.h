@@ -0,0 +1,142 @@
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <filesystem>
+
+// Time spent and bytes processed in each stage.  Stage times are summed over
+// all threads, so throughput figures are per thread.  Stages may be nested,
+// in which case the outer stage includes the time of the inner one.  Stage
+// names must be string literals.
+struct stats_registry
+{
+    using clock = std::chrono::steady_clock;
+
+    struct stage
+    {
+        std::uint64_t count = 0;
+        clock::duration time { };
+        std::uint64_t bytes = 0;
+    };
+
+    struct event
+    {
+        std::string_view name;
+        clock::time_point begin;
+        clock::duration time;
+        std::uint64_t bytes;
+        std::thread::id thread;
+    };
+
+    void record(std::string_view name, clock::time_point begin, std::uint64_t bytes)
+    {
+        auto time = clock::now() - begin;
+        std::unique_lock lock { mutex };
+        auto& s = stages[name];
+        ++s.count;
+        s.time += time;
+        s.bytes += bytes;
+        if (tracing) events.push_back({ name, begin, time, bytes, std::this_thread::get_id() });
+    }
+
+    void print(std::ostream& out)
+    {
+        std::unique_lock lock { mutex };
+        out << std::left << std::setw(16) << "stage" << std::right
+            << std::setw(8) << "count" << std::setw(12) << "time (s)"
+            << std::setw(12) << "MB" << std::setw(12) << "MB/s" << '\n';
+        out << std::fixed;
+        for (auto& [name, s] : stages)
+        {
+            out << std::left << std::setw(16) << name << std::right
+                << std::setw(8) << s.count
+                << std::setw(12) << std::setprecision(4) << seconds(s.time)
+                << std::setw(12) << std::setprecision(3) << s.bytes / 1e6;
+            if (s.bytes > 0 and s.time.count() > 0) out << std::setw(12) << std::setprecision(1) << s.bytes / 1e6 / seconds(s.time);
+            out << '\n';
+        }
+        out << "wall time: " << std::setprecision(4) << seconds(clock::now() - start) << " s\n";
+        out << std::defaultfloat;
+    }
+
+    void write_json(const std::filesystem::path& file)
+    {
+        std::ofstream out { file, std::ios::out | std::ios::trunc };
+        out.exceptions(std::ios::badbit | std::ios::failbit);
+        std::unique_lock lock { mutex };
+        out << "{\n  \"wall_time_s\": " << seconds(clock::now() - start) << ",\n  \"stages\": {";
+        const char* sep = "\n";
+        for (auto& [name, s] : stages)
+        {
+            out << sep << "    \"" << name << "\": { \"count\": " << s.count
+                << ", \"time_s\": " << seconds(s.time) << ", \"bytes\": " << s.bytes << " }";
+            sep = ",\n";
+        }
+        out << "\n  }\n}\n";
+    }
+
+    // Chrome trace-event format, as read by chrome://tracing or Perfetto.
+    void write_trace(const std::filesystem::path& file)
+    {
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+
+        std::ofstream out { file, std::ios::out | std::ios::trunc };
+        out.exceptions(std::ios::badbit | std::ios::failbit);
+        std::unique_lock lock { mutex };
+        std::map<std::thread::id, unsigned> threads;
+        out << "{ \"traceEvents\": [";
+        const char* sep = "\n";
+        for (auto& e : events)
+        {
+            auto tid = threads.try_emplace(e.thread, threads.size()).first->second;
+            out << sep << "  { \"name\": \"" << e.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << tid
+                << ", \"ts\": " << duration_cast<microseconds>(e.begin - start).count()
+                << ", \"dur\": " << duration_cast<microseconds>(e.time).count()
+                << ", \"args\": { \"bytes\": " << e.bytes << " } }";
+            sep = ",\n";
+        }
+        out << "\n] }\n";
+    }
+
+    // Output everything that was requested on the command line.
+    void report(bool summary, const std::filesystem::path& json, const std::filesystem::path& trace)
+    {
+        if (summary) print(std::cout);
+        if (not json.empty()) write_json(json);
+        if (not trace.empty()) write_trace(trace);
+    }
+
+    bool tracing = false;
+
+private:
+    static double seconds(clock::duration d) { return std::chrono::duration<double> { d }.count(); }
+
+    std::mutex mutex;
+    std::map<std::string_view, stage> stages;
+    std::vector<event> events;
+    const clock::time_point start = clock::now();
+};
+
+inline stats_registry stats { };
+
+// Records the time from construction to destruction under the given stage.
+struct scoped_timer
+{
+    scoped_timer(std::string_view name, std::uint64_t bytes = 0) : name { name }, bytes { bytes } { }
+    ~scoped_timer() { stats.record(name, begin, bytes); }
+
+    scoped_timer(const scoped_timer&) = delete;
+    scoped_timer& operator=(const scoped_timer&) = delete;
+
+    std::string_view name;
+    std::uint64_t bytes;
+    stats_registry::clock::time_point begin = stats_registry::clock::now();
+};
@@ -0,0 +1,260 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <random>
+#include <algorithm>
+#include <stdexcept>
+
+#include "archive.h"
+#include "formats.h"
+#include "options.h"
+
+// Generators for synthetic archives and assets, so that the tools can be
+// benchmarked without the original HL.EXE.
+
+// Reference compressor producing the format read by decompress().  A
+// back-reference is encoded as the magic byte followed by a 16-bit word
+// holding the length (6 bits) and distance - 1 (10 bits).  A literal magic
+// byte is encoded as magic, 0, 0.  Returns an empty vector if the data does
+// not compress.
+inline std::vector<char> compress(const std::vector<char>& in, char& magic)
+{
+    constexpr std::size_t max_count = 63;
+    constexpr std::size_t max_distance = 0x400;
+    constexpr std::size_t min_count = 4;
+    constexpr unsigned max_chain = 32;
+
+    std::array<std::size_t, 256> freq { };
+    for (auto c : in) ++freq[static_cast<byte>(c)];
+    magic = static_cast<char>(std::min_element(freq.begin(), freq.end()) - freq.begin());
+
+    // Hash chains over 3-byte prefixes.
+    constexpr std::size_t none = -1;
+    std::vector<std::size_t> head(1 << 12, none);
+    std::vector<std::size_t> prev(in.size(), none);
+    auto hash = [&in] (std::size_t i)
+    {
+        unsigned h = static_cast<byte>(in[i]) | static_cast<byte>(in[i + 1]) << 8 | static_cast<byte>(in[i + 2]) << 16;
+        return (h * 2654435761u) >> 20;
+    };
+    auto insert = [&] (std::size_t i)
+    {
+        if (i + 2 >= in.size()) return;
+        auto& h = head[hash(i)];
+        prev[i] = h;
+        h = i;
+    };
+
+    std::vector<char> out;
+    out.reserve(in.size());
+    for (std::size_t i = 0; i < in.size();)
+    {
+        std::size_t best_count = 0, best_distance = 0;
+        if (i + 2 < in.size())
+        {
+            auto limit = std::min(max_count, in.size() - i);
+            unsigned chain = 0;
+            for (auto j = head[hash(i)]; j != none and i - j <= max_distance and chain < max_chain; j = prev[j], ++chain)
+            {
+                std::size_t n = 0;
+                while (n < limit and in[j + n] == in[i + n]) ++n;
+                if (n > best_count)
+                {
+                    best_count = n;
+                    best_distance = i - j;
+                    if (n == limit) break;
+                }
+            }
+        }
+
+        if (best_count >= min_count)
+        {
+            unsigned v = best_count << 10 | (best_distance - 1);
+            out.push_back(magic);
+            out.push_back(static_cast<char>(v & 0xff));
+            out.push_back(static_cast<char>(v >> 8));
+            for (std::size_t n = 0; n < best_count; ++n) insert(i++);
+            continue;
+        }
+
+        out.push_back(in[i]);
+        if (in[i] == magic)
+        {
+            out.push_back(0);
+            out.push_back(0);
+        }
+        insert(i++);
+    }
+
+    if (out.size() >= in.size()) out.clear();
+    return out;
+}
+
+struct synthetic_file
+{
+    std::string name;
+    std::vector<char> data;
+};
+
+// Build an executable in the layout read by 'archive': a stub, the encoded
+// (and where useful, compressed) file data, the encoded file table, and the
+// encoded volume pointers.
+inline std::vector<char> make_archive(const std::vector<synthetic_file>& files, std::size_t stub_size = 0x1000)
+{
+    std::vector<char> out(stub_size, 0);
+    if (stub_size >= 2) out[0] = 'M', out[1] = 'Z';
+    const auto data_begin = out.size();
+
+    std::vector<file_entry> table;
+    for (auto& f : files)
+    {
+        if (f.name.size() > 12) throw std::runtime_error { "File name too long: " + f.name };
+
+        file_entry e;
+        e.bytes.fill(0);
+        std::copy_n(f.name.begin(), f.name.size(), e.name);
+        auto packed = compress(f.data, e.magic);
+        e.compressed = not packed.empty();
+        if (packed.empty()) packed = f.data;
+        e.offset = out.size() - data_begin;
+        e.compressed_size = packed.size();
+        e.size = f.data.size();
+        decode(packed.begin(), packed.size());
+        out.insert(out.end(), packed.begin(), packed.end());
+        table.push_back(e);
+    }
+
+    const auto table_begin = out.size();
+    for (auto& e : table) out.insert(out.end(), e.bytes.begin(), e.bytes.end());
+    decode(out.begin() + table_begin, out.size() - table_begin);
+
+    volume_ptrs vp;
+    vp.bytes.fill(0);
+    std::memcpy(vp.volume, "volume", 6);
+    vp.num_files = table.size();
+    vp.data_offset = out.size() + 0x10 - data_begin;
+    decode(vp.bytes.begin(), 0x10);
+    out.insert(out.end(), vp.bytes.begin(), vp.bytes.end());
+    return out;
+}
+
+// A .ggs file with 'sprites' of its 64 slots filled.  Sprites are drawn as
+// runs of a few colours on a transparent background, which compresses
+// roughly like the real graphics.
+inline std::vector<char> make_ggs(std::mt19937& rng, unsigned sprites = 0x40)
+{
+    std::vector<char> out(0x30, 0);
+    std::uniform_int_distribution<unsigned> colour { 0, 15 }, run { 1, 8 }, value { 0, 255 };
+    for (unsigned n = 0; n < 0x40; ++n)
+    {
+        if (n >= sprites)
+        {
+            out.push_back(static_cast<char>(0xff));
+            continue;
+        }
+        out.push_back(0);
+
+        image_chunk chunk;
+        for (auto& c : chunk.bytes) c = static_cast<char>(value(rng));
+        for (unsigned i = 0; i < 24 * 24;)
+        {
+            byte c = colour(rng) < 4 ? 0xff : colour(rng);
+            for (auto end = std::min(i + run(rng), 24u * 24u); i < end; ++i) chunk.image[i] = c;
+        }
+        for (auto& c : chunk.vga_lookup) c = value(rng);
+        out.insert(out.end(), chunk.bytes.begin(), chunk.bytes.end());
+    }
+    return out;
+}
+
+// 8-bit unsigned PCM made of silence, short noise bursts, and tones that
+// repeat a single period of a quantized sine wave, so that most of it
+// compresses to back-references.
+inline std::vector<char> make_snd(std::mt19937& rng, std::size_t size)
+{
+    std::uniform_int_distribution<unsigned> kind { 0, 7 }, length { 0x80, 0x800 }, burst { 0x10, 0x40 };
+    std::uniform_int_distribution<unsigned> period { 8, 64 }, amplitude { 1, 15 }, noise { 0, 255 };
+    std::vector<char> out;
+    out.reserve(size);
+    while (out.size() < size)
+    {
+        auto k = kind(rng);
+        auto n = std::min<std::size_t>(k == 1 ? burst(rng) : length(rng), size - out.size());
+        if (k == 0) out.insert(out.end(), n, static_cast<char>(128));
+        else if (k == 1) for (std::size_t i = 0; i < n; ++i) out.push_back(static_cast<char>(noise(rng)));
+        else
+        {
+            std::vector<char> wave(period(rng));
+            const double a = amplitude(rng);
+            for (std::size_t i = 0; i < wave.size(); ++i)
+                wave[i] = static_cast<char>(128 + 8 * std::lround(a * std::sin(i * 6.2832 / wave.size())));
+            for (std::size_t i = 0; i < n; ++i) out.push_back(wave[i % wave.size()]);
+        }
+    }
+    return out;
+}
+
+// Command line options describing the corpus built by make_corpus().
+struct corpus_options
+{
+    enum parse_result { unknown, ok, invalid };
+
+    // Parse one command line argument, if it is a corpus option.
+    parse_result parse(std::string_view arg)
+    {
+        auto param = [&arg] (std::string_view prefix)
+        {
+            if (arg.starts_with(prefix))
+            {
+                arg.remove_prefix(prefix.size());
+                return true;
+            }
+            return false;
+        };
+
+        bool valid;
+        if (param("--seed=")) valid = parse_number(arg, seed, 0, -1);
+        else if (param("--ggs=")) valid = parse_number(arg, ggs, 0, 10000);
+        else if (param("--snd=")) valid = parse_number(arg, snd, 0, 10000);
+        else if (param("--snd-size=")) valid = parse_number(arg, snd_size, 1, 1 << 26);
+        else if (param("--fragment-size=")) valid = parse_number(arg, fragment_size, 1, 1 << 20);
+        else return unknown;
+        return valid ? ok : invalid;
+    }
+
+    static constexpr std::string_view help =
+        "      --seed=N        Seed for the random generator. (default: 1)\n"
+        "      --ggs=N         Number of .ggs files. (default: 16)\n"
+        "      --snd=N         Number of .snd files, besides the soundtrack. (default: 32)\n"
+        "      --snd-size=N    Size of each .snd file in bytes. (default: 16384)\n"
+        "      --fragment-size=N Size of each soundtrack fragment in bytes. (default: 2048)\n";
+
+    unsigned seed = 1;
+    unsigned ggs = 16;
+    unsigned snd = 32;
+    unsigned snd_size = 0x4000;
+    unsigned fragment_size = 0x800;
+};
+
+// A set of files resembling the game's: graphics files, sound effects, and
+// the soundtrack fragments, as described by 'opt'.
+inline std::vector<synthetic_file> make_corpus(const corpus_options& opt)
+{
+    std::mt19937 rng { opt.seed };
+    std::vector<synthetic_file> files;
+    for (unsigned i = 0; i < opt.ggs; ++i)
+        files.push_back({ "gfx" + std::to_string(i) + ".ggs", make_ggs(rng) });
+    for (unsigned i = 0; i < opt.snd; ++i)
+        files.push_back({ "sfx" + std::to_string(i) + ".snd", make_snd(rng, opt.snd_size) });
+    for (char c = 'a'; c <= 'z'; ++c)
+    {
+        if (soundtrack_sequence.find(c) == std::string_view::npos) continue;
+        files.push_back({ soundtrack_fragment(c), make_snd(rng, opt.fragment_size) });
+    }
+    return files;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+// Minimal fixed-size worker pool.  Jobs may submit further jobs.  The first
+// exception thrown by any job is rethrown from wait().
+struct thread_pool
+{
+    explicit thread_pool(unsigned n = 0)
+    {
+        if (n == 0) n = std::max(std::thread::hardware_concurrency(), 1u);
+        for (unsigned i = 0; i < n; ++i) threads.emplace_back([this] { run(); });
+    }
+
+    ~thread_pool()
+    {
+        {
+            std::unique_lock lock { mutex };
+            stop = true;
+        }
+        job_ready.notify_all();
+        for (auto& t : threads) t.join();
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    void submit(std::function<void()> job)
+    {
+        {
+            std::unique_lock lock { mutex };
+            jobs.push_back(std::move(job));
+            ++pending;
+        }
+        job_ready.notify_one();
+    }
+
+    void wait()
+    {
+        if (auto e = wait_for_all()) std::rethrow_exception(e);
+    }
+
+    // Like wait(), but returns the first exception instead of rethrowing it,
+    // so that the caller can save its progress first.
+    std::exception_ptr wait_for_all()
+    {
+        std::unique_lock lock { mutex };
+        idle.wait(lock, [this] { return pending == 0; });
+        return std::exchange(error, nullptr);
+    }
+
+private:
+    void run()
+    {
+        std::unique_lock lock { mutex };
+        while (true)
+        {
+            job_ready.wait(lock, [this] { return stop or not jobs.empty(); });
+            if (jobs.empty()) return;
+
+            auto job = std::move(jobs.front());
+            jobs.pop_front();
+            lock.unlock();
+            try { job(); }
+            catch (...)
+            {
+                lock.lock();
+                if (not error) error = std::current_exception();
+                lock.unlock();
+            }
+            lock.lock();
+            if (--pending == 0) idle.notify_all();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable job_ready;
+    std::condition_variable idle;
+    std::deque<std::function<void()>> jobs;
+    std::size_t pending = 0;
+    std::exception_ptr error;
+    bool stop = false;
+    std::vector<std::thread> threads;
+};